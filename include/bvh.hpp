@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <vector>
+
+#include "cligx.hpp"
+
+namespace CLIGx {
+
+/**
+ * @brief Bounding volume hierarchy over a triangle mesh, used for ray picking.
+ *
+ * Built once with binned SAH, where the top levels of the tree are built in parallel.
+ * Nodes are stored flat in depth first order so a query only walks a contiguous array.
+ */
+class BVH {
+public:
+    /**
+     * @brief Result of a successful `BVH::pick`.
+     */
+    struct Hit {
+        float t;              // Distance along the ray
+        vec3 point;           // World space hit point
+        std::size_t triangle; // Index into the triangles the BVH was built from
+        int vertex;           // Corner of `triangle` (0-2) closest to `point`
+    };
+
+    //! @cond Doxygen_Suppress
+    struct Node {
+        vec3 min, max;
+        std::uint32_t index; // First triangle for a leaf, right child for an interior node
+        std::uint32_t count; // Triangles in a leaf, 0 for an interior node
+    };
+    //! @endcond
+
+    BVH() = default;
+
+    /**
+     * @brief Build a BVH over a triangle list.
+     *
+     * @param triangles Triangles to build over, copied into the BVH in traversal order.
+     * @param threads Max number of threads used while building. 0 uses `std::thread::hardware_concurrency`.
+     */
+    explicit BVH(const std::vector<Triangle> &triangles, unsigned int threads = 0);
+
+    /**
+     * @brief Find the nearest triangle hit by a ray.
+     *
+     * @param ray The ray to cast. `direction` does not need to be normalized.
+     * @param tMin Closest distance along the ray to accept.
+     * @param tMax Furthest distance along the ray to accept.
+     * @return The nearest hit, or nothing if the ray missed.
+     *
+     * @see CLIGraphics::cellRay
+     */
+    std::optional<Hit> pick(const Ray &ray, float tMin = -std::numeric_limits<float>::max(), float tMax = std::numeric_limits<float>::max()) const;
+
+    /**
+     * @brief Triangle by its original index, as returned in `Hit::triangle`.
+     */
+    const Triangle &triangle(std::size_t index) const {
+        return triangles[remap[index]];
+    }
+
+    bool empty() const {
+        return nodes.empty();
+    }
+
+private:
+    std::vector<Node> nodes;
+    std::vector<Triangle> triangles;     // Reordered so each leaf is contiguous
+    std::vector<std::uint32_t> original; // Traversal order -> original index
+    std::vector<std::uint32_t> remap;    // Original index -> traversal order
+    std::size_t depth = 0;               // Levels in the tree, bounds the traversal stack
+};
+
+} // namespace CLIGx
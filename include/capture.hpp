@@ -0,0 +1,103 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cell.hpp"
+
+namespace CLIGx {
+
+/**
+ * @brief Records presented frames to an asciicast v2 file.
+ *
+ * Frames are copied into a small bounded ring and encoded by a background thread, which only writes the cells that changed
+ * since the last written frame. When the ring is full, frames are dropped instead of blocking the caller, the next frame
+ * written will still be diffed against what the recording last showed.
+ */
+class Capture {
+private:
+    static constexpr std::size_t RING_SIZE = 8;
+
+    //! @cond Doxygen_Suppress
+    struct Frame {
+        std::vector<int> cells;
+        const char *const *charSet = nullptr;
+        const std::string *colors = nullptr;
+        double time = 0.0;
+    };
+    //! @endcond
+
+    std::size_t width = 0, height = 0;
+    std::ofstream file;
+    std::chrono::steady_clock::time_point startTime;
+
+    std::array<Frame, RING_SIZE> ring;
+    std::size_t head = 0, count = 0;
+    std::mutex ringMux;
+    std::condition_variable ringCond;
+
+    std::atomic_bool recording = false;
+    std::atomic_size_t _dropped = 0;
+    std::jthread writerThread;
+    int writerColor = -1; // Color the recording is currently drawing with
+
+    void writeLoop(std::stop_token stop);
+
+    /**
+     * @brief Write a single frame as an output event containing the changes from `previous`.
+     */
+    void writeFrame(const Frame &frame, Frame &previous, std::string &out);
+
+public:
+    /**
+     * @brief Number of frames dropped because the writer could not keep up.
+     */
+    const std::atomic_size_t &dropped = _dropped;
+
+    Capture() = default;
+    ~Capture();
+
+    //! @cond Doxygen_Suppress
+    Capture &operator=(Capture &) = delete;
+    Capture(Capture &) = delete;
+    //! @endcond
+
+    /**
+     * @brief Start recording to a new asciicast file, stopping any current recording.
+     *
+     * @param filename Path of the `.cast` file to create.
+     * @param width Width of the frames in cells.
+     * @param height Height of the frames in cells.
+     *
+     * @retval 0 if recording started
+     * @retval 1 if the file could not be opened
+     */
+    int start(const std::string &filename, std::size_t width, std::size_t height);
+
+    /**
+     * @brief Stop recording, waiting for all queued frames to be written.
+     */
+    void stop();
+
+    /**
+     * @brief Queue a frame to be recorded. Never blocks on the writer, the frame is dropped if the ring is full.
+     *
+     * @param cells `width * height` cells, row major.
+     * @param charSet Glyphs for each glyph index. Must outlive the recording.
+     * @param colors SGR escapes for each color index, `nullptr` when monochrome. Must outlive the recording.
+     */
+    void submit(const int *cells, const char *const *charSet, const std::string *colors = nullptr);
+
+    bool active() const {
+        return recording;
+    }
+};
+
+} // namespace CLIGx
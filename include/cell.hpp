@@ -0,0 +1,11 @@
+#pragma once
+
+namespace CLIGx {
+
+/**
+ * @brief Layout of a frame buffer cell, the low bits index the charset and the high bits index the color palette.
+ */
+constexpr int CELL_COLOR_SHIFT = 16;
+constexpr int CELL_GLYPH_MASK = (1 << CELL_COLOR_SHIFT) - 1;
+
+} // namespace CLIGx
@@ -3,11 +3,16 @@
 #include <algorithm>
 #include <array>
 #include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <iostream>
+#include <memory>
 #include <mutex>
 #include <ranges>
+#include <string>
 #include <thread>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <variant>
 #include <vector>
@@ -18,6 +23,9 @@
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/component_wise.hpp>
 
+#include "capture.hpp"
+#include "cell.hpp"
+
 namespace CLIGx {
 
 using vec2 = glm::lowp_vec2;
@@ -27,6 +35,8 @@ using mat4 = glm::lowp_mat4;
 
 using Line = std::pair<vec3, vec3>;
 using HLine = std::pair<vec4, vec4>;
+using Triangle = std::array<vec3, 3>;
+using Edge = std::pair<std::uint32_t, std::uint32_t>;
 using CharSet = std::vector<const char *>;
 
 static const CharSet CHARSET_braille = std::vector{" ", "⠁", "⠄", "⠅", "⠕", "⢕", "⢝", "⢵", "⢽", "⢿", "⣿"};
@@ -39,6 +49,52 @@ static const CharSet CHARSET_combo = std::vector{" ", ".", "⠁", "⠄", ":", "
 
 constexpr float pi = glm::pi<float>();
 
+/**
+ * @brief How depth is encoded as foreground color. Glyphs then represent line coverage instead of depth.
+ */
+enum class ColorMode {
+    Monochrome, // Depth is encoded by the glyph, no escapes are emitted
+    Palette256, // 256 color SGR escapes
+    TrueColor,  // 24 bit SGR escapes
+};
+
+/**
+ * @brief Max number of buckets depth is quantized into. Kept small so neighboring cells share a color and escapes are only
+ * emitted at bucket boundaries.
+ */
+constexpr int COLOR_BUCKETS = 12;
+
+/**
+ * @brief SGR escape for each depth bucket, far to near.
+ *
+ * @return Empty for `ColorMode::Monochrome`. Otherwise up to `COLOR_BUCKETS` distinct escapes which stay valid for the
+ * whole program. Buckets that would map to the same palette color are merged.
+ */
+inline const std::vector<std::string> &colorPalette(ColorMode mode) {
+    static const std::array<std::vector<std::string>, 3> palettes = [] {
+        std::array<std::vector<std::string>, 3> palettes;
+        const vec3 farColor{48.0f, 64.0f, 160.0f}, nearColor{255.0f, 224.0f, 128.0f};
+        for (int i = 0; i < COLOR_BUCKETS; ++i) {
+            vec3 rgb = glm::mix(farColor, nearColor, float(i) / (COLOR_BUCKETS - 1));
+            glm::ivec3 cube = glm::ivec3(glm::round(rgb / 255.0f * 5.0f));
+            palettes[int(ColorMode::Palette256)].push_back("\x1b[38;5;" + std::to_string(16 + 36 * cube.r + 6 * cube.g + cube.b) + "m");
+            palettes[int(ColorMode::TrueColor)].push_back("\x1b[38;2;" + std::to_string(int(rgb.r)) + ";" + std::to_string(int(rgb.g)) + ";" + std::to_string(int(rgb.b)) + "m");
+        }
+        for (auto &palette : palettes)
+            palette.erase(std::unique(palette.begin(), palette.end()), palette.end());
+        return palettes;
+    }();
+    return palettes[int(mode)];
+}
+
+/**
+ * @brief A world space ray, as produced by `CLIGraphics::cellRay`.
+ */
+struct Ray {
+    vec3 origin;
+    vec3 direction;
+};
+
 struct VecHash {
     template <glm::length_t N, typename T, glm::qualifier Q>
     constexpr std::size_t operator()(const glm::vec<N, T, Q> &vertex) const {
@@ -60,6 +116,125 @@ struct LineHash {
     }
 };
 
+/**
+ * @brief Indexed edge geometry shared by every instance drawing it.
+ */
+struct Mesh {
+    std::vector<vec3> vertices;
+    std::vector<Edge> edges;
+    vec3 center{0.0f}; // Bounding sphere in model space
+    float radius = 0.0f;
+
+    Mesh() = default;
+
+    /**
+     * @brief Build a mesh from triangles, merging shared vertices and edges.
+     */
+    explicit Mesh(const std::vector<Triangle> &triangles) {
+        std::unordered_map<vec3, std::uint32_t, VecHash> indices;
+        std::unordered_set<std::uint64_t> edgeSet;
+
+        auto index = [&](const vec3 &v) {
+            auto [it, added] = indices.try_emplace(v, static_cast<std::uint32_t>(vertices.size()));
+            if (added)
+                vertices.push_back(v);
+            return it->second;
+        };
+
+        for (const Triangle &t : triangles) {
+            std::array<std::uint32_t, 3> i{index(t[0]), index(t[1]), index(t[2])};
+            for (int j = 0; j < 3; ++j) {
+                Edge edge = std::minmax(i[j], i[(j + 1) % 3]);
+                if (edgeSet.insert(std::uint64_t(edge.first) << 32 | edge.second).second)
+                    edges.push_back(edge);
+            }
+        }
+
+        computeBounds();
+    }
+
+    /**
+     * @brief Build a mesh from existing vertices and edges.
+     */
+    Mesh(std::vector<vec3> vertices, std::vector<Edge> edges) : vertices(std::move(vertices)), edges(std::move(edges)) {
+        computeBounds();
+    }
+
+private:
+    void computeBounds() {
+        if (vertices.empty())
+            return;
+
+        vec3 min = vertices[0], max = vertices[0];
+        for (const vec3 &v : vertices) {
+            min = glm::min(min, v);
+            max = glm::max(max, v);
+        }
+        center = (min + max) * 0.5f;
+        for (const vec3 &v : vertices)
+            radius = std::max(radius, glm::distance(center, v));
+    }
+};
+
+/**
+ * @brief A placement of a `Mesh` in the world.
+ */
+struct Instance {
+    std::size_t mesh;
+    mat4 model;
+    bool visible = true;
+};
+
+/**
+ * @brief A set of meshes and instances of them, drawn with `CLIGraphics::drawScene`.
+ *
+ * Meshes are stored once, so memory scales with unique meshes rather than instances.
+ */
+class Scene {
+private:
+    std::vector<Mesh> _meshes;
+    std::vector<Instance> _instances;
+
+public:
+    /**
+     * @brief Add a mesh to the scene.
+     *
+     * @return Index of the mesh, used with `Scene::addInstance`.
+     */
+    std::size_t addMesh(Mesh mesh) {
+        _meshes.push_back(std::move(mesh));
+        return _meshes.size() - 1;
+    }
+
+    /**
+     * @brief Place a mesh in the scene.
+     *
+     * @param mesh Index returned by `Scene::addMesh`.
+     * @param model Model to world transform of the instance.
+     * @return Index of the instance, used with `Scene::setModel`.
+     */
+    std::size_t addInstance(std::size_t mesh, const mat4 &model = mat4(1.0f)) {
+        _instances.push_back(Instance{mesh, model, true});
+        return _instances.size() - 1;
+    }
+
+    void setModel(std::size_t instance, const mat4 &model) {
+        _instances[instance].model = model;
+    }
+
+    void setVisible(std::size_t instance, bool visible) {
+        _instances[instance].visible = visible;
+    }
+
+    const std::vector<Mesh> &meshes() const {
+        return _meshes;
+    }
+
+    const std::vector<Instance> &instances() const {
+        return _instances;
+    }
+};
+
 template <std::size_t width, std::size_t height>
 class CLIGraphics {
 private:
@@ -68,6 +243,7 @@ private:
     // const char *BLANK = " ";
     const char **charSet;
     std::size_t charLen;
+    const std::vector<std::string> *colors = &colorPalette(ColorMode::Monochrome);
     vec4 screenSpace{width, height, 0.0f, 1.0f};
     float screenSpaceMax;
 
@@ -83,9 +259,25 @@ private:
     std::mutex viewMatrixMux;
     std::mutex prebufferMux;
     std::mutex charSetMux;
+    Capture capture;
     std::jthread renderThread;
     bool renderThreadRunning = true;
 
+    //! @cond Doxygen_Suppress
+    // Scene drawing workers, kept alive between frames along with their scratch buffers
+    struct Scratch {
+        Buffer cells;
+    };
+    std::vector<std::pair<const Mesh *, mat4>> visible;
+    std::vector<std::unique_ptr<Scratch>> scratch;
+    std::vector<std::jthread> workers;
+    std::mutex workMux;
+    std::condition_variable workCond, doneCond;
+    std::size_t workGeneration = 0;
+    std::size_t workPending = 0;
+    unsigned int workThreads = 1;
+    //! @endcond
+
     void renderLoop(int updateTime_ms) {
         int *ptr = &buffer[0][0];
         int *endPtr = ptr + (height * width);
@@ -104,11 +296,21 @@ private:
                 std::lock_guard<std::mutex> guardC(charSetMux);
                 std::lock_guard<std::mutex> guardB(bufferMux);
                 buf.clear();
+                int color = -1;
                 for (ptr = &buffer[0][0]; ptr != endPtr; ++ptr) {
-                    buf += charSet[*ptr];
+                    int glyph = *ptr & CELL_GLYPH_MASK;
+                    // Only emit an escape when the color changes, blanks keep whatever color is current
+                    if (!colors->empty() && glyph != 0 && (*ptr >> CELL_COLOR_SHIFT) != color) {
+                        color = *ptr >> CELL_COLOR_SHIFT;
+                        buf += (*colors)[color];
+                    }
+                    buf += charSet[glyph];
                     if ((ptr + 1 - &buffer[0][0]) % width == 0)
                         buf += '\n';
                 }
+                if (color != -1)
+                    buf += "\x1b[0m";
+                capture.submit(&buffer[0][0], charSet, colors->empty() ? nullptr : colors->data());
             }
             buf += '\n';
             // clearScreen();
@@ -117,6 +319,140 @@ private:
         }
     }
 
+    void refreshViewMatrix() {
+        if (updateViewMatrix) {
+            std::lock_guard<std::mutex> guard(viewMatrixMux);
+            viewMatrix = glm::lookAt(_eye, _center, _up);
+            updateViewMatrix = false;
+        }
+    }
+
+    /**
+     * @brief Combine two cells drawn to the same position. Depth keeps the nearest, coverage adds up the lines
+     * crossing the cell, as each line contributes at most once.
+     */
+    int mergeCell(int a, int b) const {
+        if (colors->empty())
+            return std::max(a, b);
+        int glyph = std::min((a & CELL_GLYPH_MASK) + (b & CELL_GLYPH_MASK), (int)charLen - 1);
+        return std::max(a >> CELL_COLOR_SHIFT, b >> CELL_COLOR_SHIFT) << CELL_COLOR_SHIFT | glyph;
+    }
+
+    glm::ivec2 cellOf(const vec4 &point) const {
+        return glm::ivec2{int((point.x + 1.0f) * 0.5f * (width)), int((1.0f - point.y) * 0.5f * (height))};
+    }
+
+    /**
+     * @param cover Whether this point adds to the coverage of its cell. Lines only cover each cell they cross once.
+     */
+    void drawPoint(Buffer &target, vec4 point, bool cover = true) {
+        glm::ivec2 cell = cellOf(point);
+        int x = cell.x;
+        int y = cell.y;
+        int z = (point.z + 1.0f) * 0.5f * (charLen);
+
+        int _x = std::clamp(x, 0, (int)width - 1);
+        int _y = std::clamp(y, 0, (int)height - 1);
+        z = std::clamp(z, 1, (int)charLen - 1);
+
+        if (x != _x || y != _y)
+            return;
+
+        if (colors->empty()) {
+            target[y][x] = std::max(target[y][x], z); // FIXME: depth check needed
+        } else {
+            int buckets = static_cast<int>(colors->size());
+            int color = std::clamp(int((point.z + 1.0f) * 0.5f * buckets), 0, buckets - 1);
+            target[y][x] = mergeCell(target[y][x], color << CELL_COLOR_SHIFT | (cover ? 1 : 0));
+        }
+    }
+
+    void drawLine(Buffer &target, const mat4 &transform, const vec4 &first, const vec4 &second) {
+        vec4 p0 = transform * first;
+        vec4 pd = transform * second - p0;
+
+        // Clip to the visible range so the samples are only spent on cells that are on screen
+        float t0 = 0.0f, t1 = 1.0f;
+        for (int axis = 0; axis < 2; ++axis) {
+            if (pd[axis] == 0.0f) {
+                if (std::abs(p0[axis]) > 1.0f)
+                    return;
+                continue;
+            }
+            float a = (-1.0f - p0[axis]) / pd[axis];
+            float b = (1.0f - p0[axis]) / pd[axis];
+            t0 = std::max(t0, std::min(a, b));
+            t1 = std::min(t1, std::max(a, b));
+        }
+        if (t0 > t1)
+            return;
+
+        vec4 px = p0 + pd * t0;
+        pd *= t1 - t0;
+
+        // Sample about twice per cell crossed, so the step count follows the on screen length of the line
+        float cells = std::max(std::abs(pd.x) * 0.5f * width, std::abs(pd.y) * 0.5f * height);
+        std::size_t steps = static_cast<std::size_t>(cells * 2.0f) + 1;
+        vec4 pdv = pd / float(steps);
+
+        glm::ivec2 last{-1, -1};
+        for (std::size_t i = 0; i <= steps; i++) {
+            glm::ivec2 cell = cellOf(px);
+            drawPoint(target, px, cell != last);
+            last = cell;
+            px += pdv;
+        }
+    }
+
+    /**
+     * @brief Draw every `threads`th visible instance starting at `first`.
+     */
+    void drawInstances(Buffer &target, unsigned int first) {
+        for (std::size_t i = first; i < visible.size(); i += workThreads) {
+            const auto &[mesh, transform] = visible[i];
+            for (const Edge &edge : mesh->edges)
+                drawLine(target, transform, vec4{mesh->vertices[edge.first], 1.0f}, vec4{mesh->vertices[edge.second], 1.0f});
+        }
+    }
+
+    void drawWorker(std::stop_token stop, unsigned int id, std::size_t generation) {
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(workMux);
+                workCond.wait(lock, [&] { return workGeneration != generation || stop.stop_requested(); });
+                if (stop.stop_requested())
+                    return;
+                generation = workGeneration;
+            }
+
+            if (id < workThreads) {
+                Buffer &target = scratch[id - 1]->cells;
+                std::fill(&target[0][0], &target[0][0] + (height * width), 0);
+                drawInstances(target, id);
+            }
+
+            std::lock_guard<std::mutex> guard(workMux);
+            if (--workPending == 0)
+                doneCond.notify_one();
+        }
+    }
+
+    /**
+     * @brief Grow the worker pool to at least `count` threads. Must not be called while a frame is being drawn.
+     */
+    void startWorkers(unsigned int count) {
+        std::size_t generation;
+        {
+            std::lock_guard<std::mutex> guard(workMux);
+            generation = workGeneration;
+        }
+        while (workers.size() < count) {
+            unsigned int id = static_cast<unsigned int>(workers.size()) + 1;
+            scratch.push_back(std::make_unique<Scratch>());
+            workers.emplace_back([this, id, generation](std::stop_token stop) { drawWorker(stop, id, generation); });
+        }
+    }
+
 public:
     const vec3 &eye = _eye;
     const vec3 &center = _center;
@@ -128,6 +464,14 @@ public:
     };
 
     ~CLIGraphics() {
+        for (auto &worker : workers)
+            worker.request_stop();
+        {
+            std::lock_guard<std::mutex> guard(workMux);
+        }
+        workCond.notify_all();
+        workers.clear();
+
         renderThreadRunning = false;
         renderThread.join();
     }
@@ -150,6 +494,19 @@ public:
         updateViewMatrix = true;
     }
 
+    /**
+     * @brief Start recording presented frames to an asciicast v2 file.
+     *
+     * @see Capture::start
+     */
+    int startCapture(const std::string &filename) {
+        return capture.start(filename, width, height);
+    }
+
+    void stopCapture() {
+        capture.stop();
+    }
+
     void clearScreen() {
 #if defined _WIN32
     #if defined _INC_CONIO
@@ -183,38 +540,63 @@ public:
         clearBuffer();
     }
 
-    void drawPoint(vec4 point) {
-        int x = (point.x + 1.0f) * 0.5f * (width);
-        int y = (1.0f - point.y) * 0.5f * (height);
-        int z = (point.z + 1.0f) * 0.5f * (charLen);
+    /**
+     * @brief Encode depth as foreground color and use the glyph for coverage instead.
+     *
+     * @param mode The color mode to use, `ColorMode::Monochrome` to encode depth with the glyph again.
+     */
+    void useColor(ColorMode mode) {
+        std::lock_guard<std::mutex> guard(charSetMux);
+        colors = &colorPalette(mode);
+        clearBuffer();
 
-        int _x = std::clamp(x, 0, (int)width - 1);
-        int _y = std::clamp(y, 0, (int)height - 1);
-        z = std::clamp(z, 1, (int)charLen - 1);
+        // Palettes differ in size, so the presented frame's color indices are only valid for the old one
+        std::lock_guard<std::mutex> bufferGuard(bufferMux);
+        std::fill(&buffer[0][0], &buffer[0][0] + (height * width), 0);
+    }
 
-        if (x == _x && y == _y)
-            prebuffer[y][x] = std::max(prebuffer[y][x], z); // FIXME: depth check needed
+    void drawPoint(vec4 point) {
+        drawPoint(prebuffer, point);
     }
 
     void drawLine(HLine &line) {
-        vec4 p0 = viewMatrix * line.first;
-        vec4 p1 = viewMatrix * line.second;
-        vec4 pd = glm::abs(p0 - p1) * vec4{p0.x > p1.x ? -1 : 1, p0.y > p1.y ? -1 : 1, p0.z > p1.z ? -1 : 1, p0.w > p1.w ? -1 : 1};
-        vec4 pdv = pd / screenSpaceMax; // IMPROVE: reduce steps for smaller lines
-        vec4 px = p0;
-
-        for (size_t i = 0; i < screenSpaceMax; i++) {
-            drawPoint(px);
-            px += pdv;
-        }
+        drawLine(prebuffer, viewMatrix, line.first, line.second);
     }
 
-    void drawLines(std::vector<HLine> lines) {
-        if (updateViewMatrix) {
-            viewMatrix = glm::lookAt(_eye, _center, _up);
+    /**
+     * @brief Map a position in cell space to the world space ray that is drawn there.
+     *
+     * @note The projection is orthographic, so every ray shares the view direction and the origin lies on the view plane.
+     * Geometry behind the origin is still drawn, so hits should be accepted for any `t`.
+     * @note Applies any pending camera change, so should be called from the thread that draws.
+     *
+     * @param x Horizontal position in cells, 0 is the left edge of the first column and `width` the right edge of the last.
+     * @param y Vertical position in cells, 0 is the top edge of the first row and `height` the bottom edge of the last.
+     * @return Ray through that position.
+     */
+    Ray cellRay(float x, float y) {
+        refreshViewMatrix(); // Pick against the view the next draw will use
+        mat4 inverseView;
+        {
             std::lock_guard<std::mutex> guard(viewMatrixMux);
-            updateViewMatrix = false;
+            inverseView = glm::inverse(viewMatrix);
         }
+        float ndcX = x / width * 2.0f - 1.0f;
+        float ndcY = 1.0f - y / height * 2.0f;
+        return Ray{vec3(inverseView * vec4{ndcX, ndcY, 0.0f, 1.0f}), glm::normalize(vec3(inverseView * vec4{0.0f, 0.0f, -1.0f, 0.0f}))};
+    }
+
+    /**
+     * @brief Map a cell to the world space ray through its center.
+     *
+     * @see CLIGraphics::cellRay(float, float)
+     */
+    Ray cellRay(int column, int row) {
+        return cellRay(column + 0.5f, row + 0.5f);
+    }
+
+    void drawLines(std::vector<HLine> lines) {
+        refreshViewMatrix();
 
         {
             std::lock_guard<std::mutex> guard(charSetMux);
@@ -228,6 +610,67 @@ public:
         std::swap(buffer, prebuffer);
     }
 
+    /**
+     * @brief Draw every instance of a scene.
+     *
+     * Instances whose bounding sphere is outside the view are skipped. The rest are split across a pool of worker threads
+     * kept between calls, each drawing into its own scratch buffer against the shared mesh buffers, which are then merged.
+     *
+     * @param scene The scene to draw.
+     * @param threads Max number of threads to draw with. 0 uses `std::thread::hardware_concurrency`.
+     */
+    void drawScene(const Scene &scene, unsigned int threads = 0) {
+        refreshViewMatrix();
+
+        visible.clear();
+        for (const Instance &instance : scene.instances()) {
+            if (!instance.visible)
+                continue;
+            const Mesh &mesh = scene.meshes()[instance.mesh];
+            mat4 transform = viewMatrix * instance.model;
+            vec4 center = transform * vec4{mesh.center, 1.0f};
+            float scale = std::sqrt(std::max({glm::dot(transform[0], transform[0]), glm::dot(transform[1], transform[1]), glm::dot(transform[2], transform[2])}));
+            float radius = mesh.radius * scale;
+            if (std::abs(center.x) - radius > 1.0f || std::abs(center.y) - radius > 1.0f)
+                continue;
+            visible.emplace_back(&mesh, transform);
+        }
+
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        threads = std::max(1u, std::min(threads, static_cast<unsigned int>(visible.size())));
+        startWorkers(threads - 1);
+
+        {
+            std::lock_guard<std::mutex> guard(charSetMux);
+
+            {
+                std::lock_guard<std::mutex> workGuard(workMux);
+                workThreads = threads;
+                workPending = workers.size();
+                ++workGeneration;
+            }
+            workCond.notify_all();
+
+            // The calling thread draws straight into the prebuffer, workers use their scratch buffers
+            drawInstances(prebuffer, 0);
+            {
+                std::unique_lock<std::mutex> lock(workMux);
+                doneCond.wait(lock, [&] { return workPending == 0; });
+            }
+
+            for (unsigned int t = 0; t + 1 < threads; ++t) {
+                int *src = &scratch[t]->cells[0][0];
+                for (int *dst = &prebuffer[0][0], *endPtr = dst + (height * width); dst != endPtr; ++dst, ++src)
+                    *dst = mergeCell(*dst, *src);
+            }
+        }
+
+        std::lock_guard<std::mutex> preGuard(prebufferMux);
+        std::lock_guard<std::mutex> guard(bufferMux);
+        std::swap(buffer, prebuffer);
+    }
+
     static std::vector<HLine> getHLines(std::vector<Line> lines) {
         return std::ranges::to<std::vector<HLine>>(std::views::transform(lines, [](Line &line) { return HLine{vec4{line.first, 1.0f}, vec4{line.second, 1.0f}}; }));
     }
@@ -9,4 +9,8 @@ namespace stlglm {
 
 std::vector<CLIGx::Line> openSTLFile(std::string filename);
 
+std::vector<CLIGx::Triangle> openSTLTriangles(std::string filename);
+
+std::vector<CLIGx::Line> getLines(const std::vector<CLIGx::Triangle> &triangles);
+
 } // namespace stlglm
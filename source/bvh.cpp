@@ -0,0 +1,282 @@
+#include "bvh.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <thread>
+
+using CLIGx::BVH;
+using CLIGx::vec3;
+
+namespace {
+
+constexpr int BINS = 16;
+constexpr std::uint32_t MIN_LEAF = 2;
+constexpr std::uint32_t MAX_LEAF = 16;
+constexpr std::size_t STACK_SIZE = 64;
+constexpr float INF = std::numeric_limits<float>::max();
+
+struct Bounds {
+    vec3 min{INF};
+    vec3 max{-INF};
+
+    void grow(const vec3 &p) {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+
+    void grow(const Bounds &b) {
+        min = glm::min(min, b.min);
+        max = glm::max(max, b.max);
+    }
+
+    float area() const {
+        vec3 e = max - min;
+        return e.x < 0.0f ? 0.0f : e.x * e.y + e.y * e.z + e.z * e.x;
+    }
+};
+
+struct Bin {
+    Bounds bounds;
+    std::uint32_t count = 0;
+};
+
+/**
+ * @brief Recursive binned SAH builder. Each call writes the subtree over `indices[begin, end)` depth first into `nodes`
+ * starting at `at`, which needs room for `2 * (end - begin) - 1` nodes. Subtrees built on separate threads use their own
+ * arrays, which are then copied into place.
+ */
+struct Builder {
+    const std::vector<Bounds> &bounds;
+    const std::vector<vec3> &centroids;
+    std::vector<std::uint32_t> &indices;
+
+    /**
+     * @return Index one past the last node of the subtree.
+     */
+    std::uint32_t build(std::vector<BVH::Node> &nodes, std::uint32_t at, std::uint32_t begin, std::uint32_t end, unsigned int threads) const {
+        Bounds nodeBounds, centroidBounds;
+        for (std::uint32_t i = begin; i != end; ++i) {
+            nodeBounds.grow(bounds[indices[i]]);
+            centroidBounds.grow(centroids[indices[i]]);
+        }
+
+        std::uint32_t count = end - begin;
+        nodes[at] = BVH::Node{nodeBounds.min, nodeBounds.max, begin, count};
+        if (count <= MIN_LEAF)
+            return at + 1;
+
+        vec3 extent = centroidBounds.max - centroidBounds.min;
+        int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+        if (extent[axis] <= 0.0f) // All centroids coincide, nothing to split on
+            return at + 1;
+
+        auto binOf = [&](std::uint32_t triangle) {
+            int bin = static_cast<int>((centroids[triangle][axis] - centroidBounds.min[axis]) / extent[axis] * BINS);
+            return std::min(bin, BINS - 1);
+        };
+
+        std::array<Bin, BINS> bins;
+        for (std::uint32_t i = begin; i != end; ++i) {
+            Bin &bin = bins[binOf(indices[i])];
+            bin.bounds.grow(bounds[indices[i]]);
+            bin.count++;
+        }
+
+        // Sweep from the right to get the cost of every right side, then from the left to evaluate each split
+        std::array<float, BINS> rightCost;
+        Bounds right;
+        std::uint32_t rightCount = 0;
+        for (int i = BINS - 1; i > 0; --i) {
+            right.grow(bins[i].bounds);
+            rightCount += bins[i].count;
+            rightCost[i] = right.area() * rightCount;
+        }
+
+        Bounds left;
+        std::uint32_t leftCount = 0;
+        float bestCost = INF;
+        int bestSplit = 0;
+        for (int i = 1; i < BINS; ++i) {
+            left.grow(bins[i - 1].bounds);
+            leftCount += bins[i - 1].count;
+            float cost = left.area() * leftCount + rightCost[i];
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestSplit = i;
+            }
+        }
+
+        float leafCost = nodeBounds.area() * count;
+        if (bestCost >= leafCost && count <= MAX_LEAF)
+            return at + 1;
+
+        auto first = indices.begin() + begin, last = indices.begin() + end;
+        std::uint32_t mid = static_cast<std::uint32_t>(std::partition(first, last, [&](std::uint32_t t) { return binOf(t) < bestSplit; }) - indices.begin());
+        if (mid == begin || mid == end) { // Degenerate binning, fall back to a median split
+            mid = begin + count / 2;
+            std::nth_element(first, indices.begin() + mid, last, [&](std::uint32_t a, std::uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+        }
+
+        // Depth first layout: left child directly follows its parent, the parent stores where the right child starts
+        if (threads <= 1) {
+            std::uint32_t rightStart = build(nodes, at + 1, begin, mid, 1);
+            nodes[at] = BVH::Node{nodeBounds.min, nodeBounds.max, rightStart, 0};
+            return build(nodes, rightStart, mid, end, 1);
+        }
+
+        std::vector<BVH::Node> leftNodes(2 * (mid - begin) - 1), rightNodes(2 * (end - mid) - 1);
+        std::uint32_t leftSize, rightSize;
+        {
+            std::jthread leftThread([&] { leftSize = build(leftNodes, 0, begin, mid, threads / 2); });
+            rightSize = build(rightNodes, 0, mid, end, threads - threads / 2);
+        }
+
+        std::uint32_t rightStart = at + 1 + leftSize;
+        nodes[at] = BVH::Node{nodeBounds.min, nodeBounds.max, rightStart, 0};
+        auto place = [&](const std::vector<BVH::Node> &subtree, std::uint32_t size, std::uint32_t offset) {
+            for (std::uint32_t i = 0; i < size; ++i) {
+                BVH::Node node = subtree[i];
+                if (node.count == 0)
+                    node.index += offset;
+                nodes[offset + i] = node;
+            }
+        };
+        place(leftNodes, leftSize, at + 1);
+        place(rightNodes, rightSize, rightStart);
+        return rightStart + rightSize;
+    }
+};
+
+float intersectBounds(const BVH::Node &node, const vec3 &origin, const vec3 &inverseDirection, float tMin, float tMax) {
+    vec3 t0 = (node.min - origin) * inverseDirection;
+    vec3 t1 = (node.max - origin) * inverseDirection;
+    float tNear = std::max(glm::compMax(glm::min(t0, t1)), tMin);
+    float tFar = std::min(glm::compMin(glm::max(t0, t1)), tMax);
+    return tNear <= tFar ? tNear : INF;
+}
+
+} // namespace
+
+BVH::BVH(const std::vector<Triangle> &input, unsigned int threads) {
+    if (input.empty())
+        return;
+
+    std::vector<Bounds> bounds(input.size());
+    std::vector<vec3> centroids(input.size());
+    for (std::size_t i = 0; i < input.size(); ++i) {
+        for (const vec3 &v : input[i])
+            bounds[i].grow(v);
+        centroids[i] = (input[i][0] + input[i][1] + input[i][2]) / 3.0f;
+    }
+
+    original.resize(input.size());
+    std::iota(original.begin(), original.end(), 0u);
+
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    // A binary tree with at most one triangle per leaf has at most 2N - 1 nodes
+    nodes.resize(2 * input.size() - 1);
+    nodes.resize(Builder{bounds, centroids, original}.build(nodes, 0, 0, static_cast<std::uint32_t>(input.size()), threads));
+    nodes.shrink_to_fit();
+
+    // Children always follow their parent, so a single forward pass finds every node's level
+    std::vector<std::uint32_t> levels(nodes.size(), 1);
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        if (nodes[i].count == 0) {
+            levels[i + 1] = levels[i] + 1;
+            levels[nodes[i].index] = levels[i] + 1;
+        }
+        depth = std::max<std::size_t>(depth, levels[i]);
+    }
+
+    triangles.resize(input.size());
+    remap.resize(input.size());
+    for (std::uint32_t i = 0; i < original.size(); ++i) {
+        triangles[i] = input[original[i]];
+        remap[original[i]] = i;
+    }
+}
+
+std::optional<BVH::Hit> BVH::pick(const Ray &ray, float tMin, float tMax) const {
+    if (nodes.empty())
+        return std::nullopt;
+
+    vec3 inverseDirection = 1.0f / ray.direction;
+    if (intersectBounds(nodes[0], ray.origin, inverseDirection, tMin, tMax) == INF)
+        return std::nullopt;
+
+    float best = tMax;
+    std::uint32_t bestTriangle = 0;
+    float bestU = 0.0f, bestV = 0.0f;
+    bool found = false;
+
+    // At most one far child is pending per level, only unusually deep trees need the heap
+    std::uint32_t localStack[STACK_SIZE];
+    std::vector<std::uint32_t> heapStack;
+    std::uint32_t *stack = localStack;
+    if (depth > STACK_SIZE) {
+        heapStack.resize(depth);
+        stack = heapStack.data();
+    }
+    std::size_t stackSize = 0;
+    std::uint32_t current = 0;
+
+    while (true) {
+        const Node &node = nodes[current];
+        if (node.count != 0) {
+            // Möller–Trumbore
+            for (std::uint32_t i = node.index; i != node.index + node.count; ++i) {
+                const Triangle &tri = triangles[i];
+                vec3 e1 = tri[1] - tri[0];
+                vec3 e2 = tri[2] - tri[0];
+                vec3 p = glm::cross(ray.direction, e2);
+                float det = glm::dot(e1, p);
+                if (std::abs(det) < std::numeric_limits<float>::epsilon())
+                    continue;
+                float inverseDet = 1.0f / det;
+                vec3 s = ray.origin - tri[0];
+                float u = glm::dot(s, p) * inverseDet;
+                if (u < 0.0f || u > 1.0f)
+                    continue;
+                vec3 q = glm::cross(s, e1);
+                float v = glm::dot(ray.direction, q) * inverseDet;
+                if (v < 0.0f || u + v > 1.0f)
+                    continue;
+                float t = glm::dot(e2, q) * inverseDet;
+                if (t >= tMin && t < best) {
+                    best = t;
+                    bestTriangle = i;
+                    bestU = u;
+                    bestV = v;
+                    found = true;
+                }
+            }
+        } else {
+            std::uint32_t nearChild = current + 1, farChild = node.index;
+            float tNear = intersectBounds(nodes[nearChild], ray.origin, inverseDirection, tMin, best);
+            float tFar = intersectBounds(nodes[farChild], ray.origin, inverseDirection, tMin, best);
+            if (tFar < tNear) {
+                std::swap(nearChild, farChild);
+                std::swap(tNear, tFar);
+            }
+            if (tNear != INF) {
+                if (tFar != INF)
+                    stack[stackSize++] = farChild;
+                current = nearChild;
+                continue;
+            }
+        }
+
+        if (stackSize == 0)
+            break;
+        current = stack[--stackSize];
+    }
+
+    if (!found)
+        return std::nullopt;
+
+    float bestW = 1.0f - bestU - bestV;
+    int vertex = bestW >= bestU ? (bestW >= bestV ? 0 : 2) : (bestU >= bestV ? 1 : 2);
+    return Hit{best, ray.origin + ray.direction * best, original[bestTriangle], vertex};
+}
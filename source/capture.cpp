@@ -0,0 +1,167 @@
+#include "capture.hpp"
+
+#include <algorithm>
+#include <ctime>
+#include <iterator>
+
+#include <fmt/format.h>
+
+using CLIGx::Capture;
+
+// Unchanged cells bridged inside a run, cheaper than emitting another cursor move
+constexpr std::size_t MAX_GAP = 4;
+
+Capture::~Capture() {
+    stop();
+}
+
+int Capture::start(const std::string &filename, std::size_t width, std::size_t height) {
+    stop();
+
+    file.open(filename, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+        return 1;
+
+    {
+        std::lock_guard<std::mutex> guard(ringMux);
+        this->width = width;
+        this->height = height;
+        head = 0;
+        count = 0;
+        for (Frame &frame : ring)
+            frame.cells.resize(width * height);
+    }
+    _dropped = 0;
+
+    file << fmt::format("{{\"version\": 2, \"width\": {}, \"height\": {}, \"timestamp\": {}}}\n", width, height, std::time(nullptr));
+    file.flush();
+
+    startTime = std::chrono::steady_clock::now();
+    writerThread = std::jthread([this](std::stop_token stop) { writeLoop(stop); });
+    recording = true;
+    return 0;
+}
+
+void Capture::stop() {
+    if (!recording)
+        return;
+    recording = false;
+
+    writerThread.request_stop();
+    {
+        std::lock_guard<std::mutex> guard(ringMux);
+        ringCond.notify_all();
+    }
+    writerThread.join();
+    file.close();
+}
+
+void Capture::submit(const int *cells, const char *const *charSet, const std::string *colors) {
+    if (!recording)
+        return;
+
+    double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    {
+        std::lock_guard<std::mutex> guard(ringMux);
+        if (count == RING_SIZE) {
+            _dropped++;
+            return;
+        }
+        Frame &frame = ring[head];
+        std::copy(cells, cells + width * height, frame.cells.begin());
+        frame.charSet = charSet;
+        frame.colors = colors;
+        frame.time = time;
+        head = (head + 1) % RING_SIZE;
+        count++;
+    }
+    ringCond.notify_one();
+}
+
+void Capture::writeLoop(std::stop_token stop) {
+    Frame previous;
+    std::string out;
+    writerColor = -1;
+
+    while (true) {
+        const Frame *frame;
+        {
+            std::unique_lock<std::mutex> lock(ringMux);
+            ringCond.wait(lock, [&] { return count != 0 || stop.stop_requested(); });
+            if (count == 0) // Stopped and drained
+                break;
+            frame = &ring[(head + RING_SIZE - count) % RING_SIZE];
+        }
+
+        // The slot stays reserved until `count` is decremented, so it is encoded without holding the lock
+        writeFrame(*frame, previous, out);
+
+        std::lock_guard<std::mutex> guard(ringMux);
+        count--;
+    }
+
+    file.flush();
+}
+
+void Capture::writeFrame(const Frame &frame, Frame &previous, std::string &out) {
+    out.clear();
+    auto inserter = std::back_inserter(out);
+
+    bool redraw = previous.charSet != frame.charSet || previous.colors != frame.colors || previous.cells.size() != frame.cells.size();
+    if (redraw) {
+        out += "\x1b[0m\x1b[?25l\x1b[2J";
+        writerColor = -1;
+    }
+
+    for (std::size_t y = 0; y < height; ++y) {
+        const int *row = &frame.cells[y * width];
+        const int *previousRow = redraw ? nullptr : &previous.cells[y * width];
+        auto changed = [&](std::size_t x) { return redraw || row[x] != previousRow[x]; };
+
+        for (std::size_t x = 0; x < width;) {
+            if (!changed(x)) {
+                ++x;
+                continue;
+            }
+
+            std::size_t end = x + 1;
+            for (std::size_t next = end; next < width && next < end + MAX_GAP; ++next)
+                if (changed(next))
+                    end = next + 1;
+
+            fmt::format_to(inserter, "\x1b[{};{}H", y + 1, x + 1);
+            for (; x < end; ++x) {
+                int glyph = row[x] & CELL_GLYPH_MASK;
+                int color = row[x] >> CELL_COLOR_SHIFT;
+                if (frame.colors && glyph != 0 && color != writerColor) {
+                    out += frame.colors[color];
+                    writerColor = color;
+                }
+                out += frame.charSet[glyph];
+            }
+        }
+    }
+
+    previous.cells = frame.cells;
+    previous.charSet = frame.charSet;
+    previous.colors = frame.colors;
+
+    if (out.empty())
+        return;
+
+    std::string event = fmt::format("[{:.6f}, \"o\", \"", frame.time);
+    for (char c : out) {
+        if (c == '"' || c == '\\') {
+            event += '\\';
+            event += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            fmt::format_to(std::back_inserter(event), "\\u{:04x}", static_cast<int>(c));
+        } else {
+            event += c;
+        }
+    }
+    event += "\"]\n";
+    // Events are only written on change, so flushing each one is cheap and an interrupted session never ends mid event
+    file << event;
+    file.flush();
+}
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <limits>
 #include <string>
 #include <unordered_map>
 
@@ -6,14 +7,76 @@
 #include <fmt/format.h>
 #include <glm/glm.hpp>
 
+#include "bvh.hpp"
 #include "cligx.hpp"
 #include "mouse.hpp"
 #include "stlglm.hpp"
 
 auto main(int argc, char **argv) -> int {
+    cxxopts::Options options(*argv, "A 3D STL viewer in the terminal");
+
+    const std::unordered_map<std::string, CLIGx::ColorMode> colorModes{
+        {"none", CLIGx::ColorMode::Monochrome},
+        {"256", CLIGx::ColorMode::Palette256},
+        {"truecolor", CLIGx::ColorMode::TrueColor},
+    };
+
+    std::string recording;
+    std::string color;
+
+    // clang-format off
+    options.add_options()
+        ("h,help", "Show help")
+        ("r,record", "Record the session to an asciicast file", cxxopts::value(recording))
+        ("c,color", "Encode depth as color: none, 256 or truecolor", cxxopts::value(color)->default_value("none"))
+    ;
+    // clang-format on
+
+    auto result = options.parse(argc, argv);
+
+    if (result["help"].as<bool>()) {
+        std::cout << options.help() << std::endl;
+        return 0;
+    }
+
+    auto colorIt = colorModes.find(color);
+    if (colorIt == colorModes.end()) {
+        std::cerr << "unknown color mode: " << color << std::endl;
+        return 1;
+    }
+
+    constexpr int width = 100, height = 40;
+    CLIGx::CLIGraphics<width, height> gx(1, CLIGx::CHARSET_braille);
+    gx.useColor(colorIt->second);
+
+    if (!recording.empty() && gx.startCapture(recording) != 0) {
+        std::cerr << "unable to open recording file: " << recording << std::endl;
+        return 1;
+    }
+
     mouse.setClamp(500, 500);
     mouse.startPolling();
-    CLIGx::CLIGraphics<100, 40> gx(1, CLIGx::CHARSET_braille);
+
+    std::vector<CLIGx::Triangle> triangles = stlglm::openSTLTriangles("models/Stanford_Bunny_Min.stl");
+    CLIGx::BVH bvh(triangles);
+
+    // A grid of bunnies sharing one mesh, the outer ones fall in and out of view as the camera turns
+    CLIGx::Scene scene;
+    std::size_t bunny = scene.addMesh(CLIGx::Mesh(triangles));
+    std::vector<CLIGx::mat4> models;
+    for (int x = -1; x <= 1; ++x) {
+        for (int z = -1; z <= 1; ++z) {
+            CLIGx::mat4 model = glm::translate(CLIGx::mat4(1.0f), CLIGx::vec3{x * 0.8f, 0.0f, z * 0.8f});
+            models.push_back(glm::scale(model, CLIGx::vec3{0.4f}));
+            scene.addInstance(bunny, models.back());
+        }
+    }
+
+    constexpr float size = 0.02f;
+    std::size_t cross = scene.addMesh(CLIGx::Mesh(
+        {{-size, 0.0f, 0.0f}, {size, 0.0f, 0.0f}, {0.0f, -size, 0.0f}, {0.0f, size, 0.0f}, {0.0f, 0.0f, -size}, {0.0f, 0.0f, size}},
+        {{0, 1}, {2, 3}, {4, 5}}));
+    std::size_t marker = scene.addInstance(cross);
 
     while (true) {
         gx.setCenterPosition(CLIGx::vec3{mouse.x / 200.0f, mouse.y / 200.0f, mouse.wheelVertical / 10.0f});
@@ -25,7 +88,25 @@ auto main(int argc, char **argv) -> int {
         CLIGx::vec3 newPosition = gx.center + relativePosition;
         gx.setCameraPosition(newPosition);
 
-        gx.drawLines(gx.getHLines(stlglm::openSTLFile("models/Stanford_Bunny_Min.stl")));
+        // Mark the vertex under the cursor, picking each instance in its own model space
+        float cellX = (mouse.x + 500) / 1000.0f * width;
+        float cellY = (500 - mouse.y) / 1000.0f * height;
+        CLIGx::Ray ray = gx.cellRay(cellX, cellY);
+        float nearest = std::numeric_limits<float>::max();
+        bool picked = false;
+        for (const CLIGx::mat4 &model : models) {
+            CLIGx::mat4 inverseModel = glm::inverse(model);
+            CLIGx::Ray local{CLIGx::vec3(inverseModel * CLIGx::vec4{ray.origin, 1.0f}), CLIGx::vec3(inverseModel * CLIGx::vec4{ray.direction, 0.0f})};
+            if (auto hit = bvh.pick(local); hit && hit->t < nearest) {
+                nearest = hit->t;
+                CLIGx::vec3 v = bvh.triangle(hit->triangle)[hit->vertex];
+                scene.setModel(marker, glm::translate(CLIGx::mat4(1.0f), CLIGx::vec3(model * CLIGx::vec4{v, 1.0f})));
+                picked = true;
+            }
+        }
+        scene.setVisible(marker, picked);
+
+        gx.drawScene(scene);
         gx.clearBuffer();
     }
 
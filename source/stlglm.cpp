@@ -11,20 +11,27 @@ CLIGx::vec3 vertex(openstl::Vec3 v) {
 }
 
 std::vector<CLIGx::Line> stlglm::openSTLFile(std::string filename) {
-    std::unordered_set<CLIGx::Line, CLIGx::LineHash> lineSet;
-    std::vector<CLIGx::Line> lines;
+    return getLines(openSTLTriangles(filename));
+}
 
+std::vector<CLIGx::Triangle> stlglm::openSTLTriangles(std::string filename) {
     std::ifstream file(filename, std::ios::binary);
     if (!file.is_open())
-        return lines;
+        return {};
     std::vector<openstl::Triangle> rawTriangles = openstl::deserializeStl(file);
     file.close();
 
-    auto rawLines = std::views::transform(rawTriangles, [](openstl::Triangle &t) {
-                        auto v0 = vertex(t.v0);
-                        auto v1 = vertex(t.v1);
-                        auto v2 = vertex(t.v2);
-                        return std::array<CLIGx::Line, 3>{CLIGx::Line{v0, v1}, CLIGx::Line{v1, v2}, CLIGx::Line{v2, v0}};
+    return std::ranges::to<std::vector<CLIGx::Triangle>>(std::views::transform(rawTriangles, [](openstl::Triangle &t) {
+        return CLIGx::Triangle{vertex(t.v0), vertex(t.v1), vertex(t.v2)};
+    }));
+}
+
+std::vector<CLIGx::Line> stlglm::getLines(const std::vector<CLIGx::Triangle> &triangles) {
+    std::unordered_set<CLIGx::Line, CLIGx::LineHash> lineSet;
+    std::vector<CLIGx::Line> lines;
+
+    auto rawLines = std::views::transform(triangles, [](const CLIGx::Triangle &t) {
+                        return std::array<CLIGx::Line, 3>{CLIGx::Line{t[0], t[1]}, CLIGx::Line{t[1], t[2]}, CLIGx::Line{t[2], t[0]}};
                     })
                     | std::views::join;
 